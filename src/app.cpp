@@ -5,6 +5,7 @@
 #include <glm/common.hpp>
 #include <numeric>
 #include <string>
+#include "compact.hpp"
 #include "external/miniply/miniply.h"
 #include "util.hpp"
 
@@ -16,6 +17,7 @@
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 
 #include <chrono>
@@ -25,9 +27,9 @@ splat::App *app_ptr;
 
 namespace splat {
 
-App::App(char* ply_path) {
+App::App(char* ply_path, compact::Options const& compact_opts) {
     init_window();
-    load_data(ply_path);
+    load_data(ply_path, compact_opts);
     load_shaders();
     std::cout << "ok\n";
 }
@@ -58,28 +60,14 @@ void App::init_window() {
 
 /**
  * Load data from .ply file into an SSBO that is an array of `Gaussian` structs.
- * Disregards view-dependent spherical harmonic colors.
+ * Disregards view-dependent spherical harmonic colors.  Splats are filtered through
+ * `compact::filter` first and `bounds` only cover the ones that remain.
  */
-void App::load_data(char* ply_path) {
+void App::load_data(char* ply_path, compact::Options const& compact_opts) {
     // Relevant spherical harmonics https://en.wikipedia.org/wiki/Table_of_spherical_harmonics#ℓ_=_0
     const float SH_0 = 0.28209479177387814f;
     // Relevant properties of the ply file
-    const std::vector<std::string> properties = {
-        "x",
-        "y",
-        "z",
-        "f_dc_0",
-        "f_dc_1",
-        "f_dc_2",
-        "opacity",
-        "scale_0",
-        "scale_1",
-        "scale_2",
-        "rot_0",
-        "rot_1",
-        "rot_2",
-        "rot_3",
-    };
+    const std::vector<std::string>& properties = compact::FIELD_NAMES;
 
     std::cout << "Reading ply...\n";
     auto start_time = std::chrono::system_clock::now();
@@ -97,7 +85,6 @@ void App::load_data(char* ply_path) {
     }
 
     num_gaussians = reader.num_rows();
-    data.reserve(num_gaussians);
     std::cout << "Got " << num_gaussians << " gaussians (" << num_gaussians * sizeof(Gaussian) / 1e6 << "MB)\n";
 
     // Getting all the indices where the relevant splat data is stored in the file
@@ -111,16 +98,34 @@ void App::load_data(char* ply_path) {
     float* filedata = new float[properties.size() * num_gaussians];
     reader.extract_properties(gaussSplatIdx, properties.size(), miniply::PLYPropertyType::Float, filedata);
 
-    // Initial values for the bounds are taken from the first row of properties
-    bounds = {
-        {filedata[0], filedata[1], filedata[2]},
-        {filedata[0], filedata[1], filedata[2]},
-    };
+    // Drop splats that would never be visible or would wreck the bounds
+    std::cout << "Compacting gaussians...\n";
+    compact::Stats stats;
+    std::vector<size_t> kept = compact::filter(filedata, num_gaussians, compact_opts, stats);
+    compact::print_stats(stats);
+    if (!compact_opts.output_path.empty()) {
+        std::cout << "Writing " << compact_opts.output_path << "...\n";
+        compact::write_ply(compact_opts.output_path, filedata, kept);
+    }
+    num_gaussians = kept.size();
+    data.reserve(num_gaussians);
+
+    // Initial values for the bounds are taken from the first remaining row of properties
+    if (kept.empty()) {
+        std::cerr << "No gaussians left after compaction" << std::endl;
+        bounds = {glm::vec3(0.0f), glm::vec3(0.0f)};
+    } else {
+        float const* first = filedata + kept[0] * properties.size();
+        bounds = {
+            {first[0], first[1], first[2]},
+            {first[0], first[1], first[2]},
+        };
+    }
 
     // Creating gaussian splats based on the data we read in
-    for (size_t i = 0; i < num_gaussians; ++i) {
+    for (size_t i : kept) {
 
-        int offset = i * properties.size();
+        size_t offset = i * properties.size();
         Gaussian g{};
 
         g.pos = {
@@ -403,12 +408,73 @@ void App::draw() {
 
 
 int main(int argc, char** argv) {
-    if (argc < 2) {
-        std::cout << "usage: " << argv[0] << " <point_cloud.ply>\n";
+    const std::string usage = std::string("usage: ") + argv[0] +
+                              " [options] <point_cloud.ply>\n"
+                              "  --no-compact          keep every splat\n"
+                              "  --min-opacity <a>     drop splats with opacity below a\n"
+                              "  --min-scale <s>       drop splats with a scale below s\n"
+                              "  --max-scale <s>       drop splats with a scale above s\n"
+                              "  --max-anisotropy <r>  drop splats flatter than r, 0 disables\n"
+                              "  --outlier-k <k>       neighbors for outlier removal, 0 disables\n"
+                              "  --outlier-std <r>     drop splats beyond mean + r * stddev\n"
+                              "  --write-ply <path>    write the compacted scene to path\n";
+
+    // Numeric option values must be non-negative and consist of the number only.
+    auto parse_float = [](std::string const& str, float max = HUGE_VALF) {
+        size_t len;
+        float val = std::stof(str, &len);
+        if (len != str.size() || !(val >= 0.0f) || !(val <= max) || !std::isfinite(val)) {
+            throw std::invalid_argument(str);
+        }
+        return val;
+    };
+    auto parse_count = [](std::string const& str) {
+        size_t len;
+        long val = std::stol(str, &len);
+        if (len != str.size() || val < 0) {
+            throw std::invalid_argument(str);
+        }
+        return (size_t)val;
+    };
+
+    splat::compact::Options compact_opts{};
+    char* ply_path = nullptr;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc && argv[i + 1][0] != '\0';
+            if (arg == "--no-compact") {
+                compact_opts.enabled = false;
+            } else if (arg == "--min-opacity" && has_value) {
+                compact_opts.min_opacity = parse_float(argv[++i], 1.0f);
+            } else if (arg == "--min-scale" && has_value) {
+                compact_opts.min_scale = parse_float(argv[++i]);
+            } else if (arg == "--max-scale" && has_value) {
+                compact_opts.max_scale = parse_float(argv[++i]);
+            } else if (arg == "--max-anisotropy" && has_value) {
+                compact_opts.max_anisotropy = parse_float(argv[++i]);
+            } else if (arg == "--outlier-k" && has_value) {
+                compact_opts.outlier_neighbors = parse_count(argv[++i]);
+            } else if (arg == "--outlier-std" && has_value) {
+                compact_opts.outlier_std_ratio = parse_float(argv[++i]);
+            } else if (arg == "--write-ply" && has_value) {
+                compact_opts.output_path = argv[++i];
+            } else if (arg.rfind("--", 0) != 0 && ply_path == nullptr) {
+                ply_path = argv[i];
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        }
+    } catch (std::exception const&) {
+        std::cout << usage;
+        return 1;
+    }
+    if (ply_path == nullptr) {
+        std::cout << usage;
         return 1;
     }
-    char* ply_path = argv[1];
-    auto app = splat::App(ply_path);
+
+    auto app = splat::App(ply_path, compact_opts);
     app_ptr = &app;
     app.speed = 1.5f;
     app.run();
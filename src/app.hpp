@@ -2,6 +2,7 @@
 #define APP_HPP
 
 #include "camera.hpp"
+#include "compact.hpp"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -23,7 +24,7 @@ struct Gaussian {
 
 class App {
    public:
-    App(char* ply_path);
+    App(char* ply_path, compact::Options const& compact_opts = {});
     void run();
 
     const uint32_t WIDTH = 1280;
@@ -38,7 +39,7 @@ class App {
     void init_window();
     void draw();
     void process_inputs();
-    void load_data(char* ply_path);
+    void load_data(char* ply_path, compact::Options const& compact_opts);
     void load_shaders();
 
     std::vector<Gaussian> data = {};
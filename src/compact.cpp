@@ -0,0 +1,393 @@
+#include "compact.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace splat {
+
+const std::vector<std::string> compact::FIELD_NAMES = {
+    "x",
+    "y",
+    "z",
+    "f_dc_0",
+    "f_dc_1",
+    "f_dc_2",
+    "opacity",
+    "scale_0",
+    "scale_1",
+    "scale_2",
+    "rot_0",
+    "rot_1",
+    "rot_2",
+    "rot_3",
+};
+
+namespace {
+
+enum Verdict : uint8_t {
+    KEEP,
+    DEGENERATE,
+    TRANSPARENT,
+    OUTLIER,
+};
+
+// How many rings of grid cells around a splat are searched for neighbors before giving up.
+const int MAX_RING = 4;
+// Cell coordinates, counted from the robust lower bound of the scene, get this many bits per axis
+// so they can be packed into one key.  Splats in cells beyond that are outliers.
+const int CELL_BITS = 21;
+const int64_t CELL_MAX = (int64_t{1} << (CELL_BITS - 1)) - 1;
+
+/**
+ * Split [0, n) into one contiguous chunk per hardware thread and call `fn(begin, end)` on each.
+ */
+template <typename F>
+void parallel_for(size_t n, F const& fn) {
+    size_t n_threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunk = (n + n_threads - 1) / n_threads;
+    std::vector<std::thread> threads;
+    for (size_t begin = 0; begin < n; begin += chunk) {
+        threads.emplace_back(fn, begin, std::min(n, begin + chunk));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+Verdict check_splat(float const* row, compact::Options const& opts) {
+    for (int f = 0; f < compact::NUM_FIELDS; ++f) {
+        if (!std::isfinite(row[f])) {
+            return DEGENERATE;
+        }
+    }
+
+    // Scales are stored as logarithms, see `App::load_data`.
+    float s0 = std::exp(row[compact::SCALE_0]);
+    float s1 = std::exp(row[compact::SCALE_1]);
+    float s2 = std::exp(row[compact::SCALE_2]);
+    float s_min = std::min({s0, s1, s2});
+    float s_max = std::max({s0, s1, s2});
+    if (s_min < opts.min_scale || s_max > opts.max_scale) {
+        return DEGENERATE;
+    }
+    if (opts.max_anisotropy > 0.0f && s_max > opts.max_anisotropy * s_min) {
+        return DEGENERATE;
+    }
+
+    // A (near) zero quaternion collapses the covariance.
+    float q_len2 = 0.0f;
+    for (int f = compact::ROT_0; f <= compact::ROT_3; ++f) {
+        q_len2 += row[f] * row[f];
+    }
+    if (q_len2 < 1e-12f) {
+        return DEGENERATE;
+    }
+
+    float alpha = 1.0f / (1.0f + std::exp(-row[compact::OPACITY]));
+    if (alpha < opts.min_opacity) {
+        return TRANSPARENT;
+    }
+
+    return KEEP;
+}
+
+bool in_grid(int64_t c) {
+    return c >= -CELL_MAX - 1 && c <= CELL_MAX;
+}
+
+// Key of an `in_grid` cell
+uint64_t cell_key(int64_t cx, int64_t cy, int64_t cz) {
+    auto pack = [](int64_t c) { return static_cast<uint64_t>(c + CELL_MAX + 1); };
+    return pack(cx) | (pack(cy) << CELL_BITS) | (pack(cz) << (2 * CELL_BITS));
+}
+
+/**
+ * Statistical outlier removal over all rows still marked `KEEP`.  Neighbors are looked up in a
+ * uniform grid whose cell size is chosen so a splat's cell holds about `k` splats.  The initial
+ * guess uses the 1st to 99th percentile of positions so stray far points don't blow up the cells.
+ * Neighbors not found within `MAX_RING` cells count as being at the search limit, so sparse splats
+ * go through the same statistics as everything else.  Splats too far away to fit on the grid at
+ * all are outliers, unless that is most of the scene, in which case nothing is removed.
+ */
+void mark_outliers(float const* rows,
+                   std::vector<Verdict>& verdicts,
+                   compact::Options const& opts) {
+    const size_t k = opts.outlier_neighbors;
+
+    std::vector<size_t> candidates{};
+    for (size_t i = 0; i < verdicts.size(); ++i) {
+        if (verdicts[i] == KEEP) {
+            candidates.push_back(i);
+        }
+    }
+    const size_t m = candidates.size();
+    if (m <= k) {
+        return;
+    }
+
+    auto pos = [&](size_t i, int axis) { return rows[i * compact::NUM_FIELDS + axis]; };
+
+    // Robust extent of the scene
+    float origin[3];
+    float volume = 1.0f;
+    float max_extent = 0.0f;
+    std::vector<float> coords(m);
+    for (int axis = 0; axis < 3; ++axis) {
+        for (size_t c = 0; c < m; ++c) {
+            coords[c] = pos(candidates[c], axis);
+        }
+        auto lo = coords.begin() + m / 100;
+        auto hi = coords.begin() + (m - 1) - m / 100;
+        std::nth_element(coords.begin(), lo, coords.end());
+        origin[axis] = *lo;
+        std::nth_element(coords.begin(), hi, coords.end());
+        float extent = *hi - origin[axis];
+        volume *= extent;
+        max_extent = std::max(max_extent, extent);
+    }
+    float cell_size = std::cbrt(volume * k / m);
+    if (!(cell_size > 0.0f) || !std::isfinite(cell_size)) {
+        // Flat or degenerate scene, fall back to slicing the largest axis
+        cell_size = max_extent > 0.0f ? max_extent / std::cbrt((float)m) : 1.0f;
+    }
+
+    // Cell coordinate along `axis`, saturated just past the grid so the cast can't overflow
+    auto cell_of = [&](size_t i, int axis) {
+        double c = std::floor(((double)pos(i, axis) - origin[axis]) / cell_size);
+        c = std::clamp(c, (double)(-CELL_MAX - 2), (double)(CELL_MAX + 1));
+        return static_cast<int64_t>(c);
+    };
+    const uint64_t OFF_GRID = ~uint64_t{0};
+    auto key_of = [&](size_t i) {
+        int64_t cx = cell_of(i, 0);
+        int64_t cy = cell_of(i, 1);
+        int64_t cz = cell_of(i, 2);
+        return in_grid(cx) && in_grid(cy) && in_grid(cz) ? cell_key(cx, cy, cz) : OFF_GRID;
+    };
+
+    // Bucket candidates by cell: sort (key, index) pairs and remember the range of every key.
+    // Splats are rarely spread evenly, so the cell size is corrected once by the occupancy a
+    // splat actually sees (the point-weighted mean cell size) before the final bucketing.
+    // Off-grid splats sort to the back and are cut off.
+    std::vector<std::pair<uint64_t, size_t>> keyed(m);
+    for (int pass = 0; pass < 2; ++pass) {
+        parallel_for(m, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                keyed[c] = {key_of(candidates[c]), candidates[c]};
+            }
+        });
+        std::sort(keyed.begin(), keyed.end());
+        size_t n_on_grid = m;
+        while (n_on_grid > 0 && keyed[n_on_grid - 1].first == OFF_GRID) {
+            --n_on_grid;
+        }
+        if (n_on_grid < m / 2) {
+            // The grid doesn't fit the scene, rather keep everything than guess
+            return;
+        }
+        if (pass > 0) {
+            for (size_t c = n_on_grid; c < m; ++c) {
+                verdicts[keyed[c].second] = OUTLIER;
+            }
+            keyed.resize(n_on_grid);
+            break;
+        }
+        double occupancy = 0.0;
+        for (size_t c = 0; c < n_on_grid;) {
+            size_t end = c;
+            while (end < n_on_grid && keyed[end].first == keyed[c].first) {
+                ++end;
+            }
+            occupancy += (double)(end - c) * (end - c) / n_on_grid;
+            c = end;
+        }
+        if (occupancy > 0.0) {
+            cell_size *= std::cbrt(k / occupancy);
+        }
+    }
+    const size_t n_on_grid = keyed.size();
+    std::unordered_map<uint64_t, std::pair<size_t, size_t>> cells{};
+    for (size_t c = 0; c < n_on_grid;) {
+        size_t end = c;
+        while (end < n_on_grid && keyed[end].first == keyed[c].first) {
+            ++end;
+        }
+        cells[keyed[c].first] = {c, end};
+        c = end;
+    }
+    // Positions in bucket order, so scanning a cell reads contiguous memory
+    std::vector<float> sorted_pos(3 * n_on_grid);
+    parallel_for(n_on_grid, [&](size_t begin, size_t end) {
+        for (size_t e = begin; e < end; ++e) {
+            for (int axis = 0; axis < 3; ++axis) {
+                sorted_pos[3 * e + axis] = pos(keyed[e].second, axis);
+            }
+        }
+    });
+
+    // Mean distance of every candidate to its k nearest neighbors, in bucket order
+    std::vector<float> mean_dist(n_on_grid);
+    parallel_for(n_on_grid, [&](size_t begin, size_t end) {
+        std::vector<float> heap{};  // max-heap of the k smallest squared distances so far
+        heap.reserve(k);
+        for (size_t c = begin; c < end; ++c) {
+            size_t i = keyed[c].second;
+            float p[3] = {sorted_pos[3 * c], sorted_pos[3 * c + 1], sorted_pos[3 * c + 2]};
+            int64_t cx = cell_of(i, 0);
+            int64_t cy = cell_of(i, 1);
+            int64_t cz = cell_of(i, 2);
+            heap.clear();
+
+            for (int r = 0; r <= MAX_RING; ++r) {
+                for (int dx = -r; dx <= r; ++dx) {
+                    for (int dy = -r; dy <= r; ++dy) {
+                        for (int dz = -r; dz <= r; ++dz) {
+                            // Only visit the shell of the ring, inner cells were already seen
+                            if (std::max({std::abs(dx), std::abs(dy), std::abs(dz)}) != r) {
+                                continue;
+                            }
+                            if (!in_grid(cx + dx) || !in_grid(cy + dy) || !in_grid(cz + dz)) {
+                                continue;
+                            }
+                            auto cell = cells.find(cell_key(cx + dx, cy + dy, cz + dz));
+                            if (cell == cells.end()) {
+                                continue;
+                            }
+                            for (size_t e = cell->second.first; e < cell->second.second; ++e) {
+                                if (keyed[e].second == i) {
+                                    continue;
+                                }
+                                float d2 = 0.0f;
+                                for (int axis = 0; axis < 3; ++axis) {
+                                    float d = p[axis] - sorted_pos[3 * e + axis];
+                                    d2 += d * d;
+                                }
+                                if (heap.size() < k) {
+                                    heap.push_back(d2);
+                                    std::push_heap(heap.begin(), heap.end());
+                                } else if (d2 < heap.front()) {
+                                    std::pop_heap(heap.begin(), heap.end());
+                                    heap.back() = d2;
+                                    std::push_heap(heap.begin(), heap.end());
+                                }
+                            }
+                        }
+                    }
+                }
+                // Anything outside ring r is at least r cells away.
+                float reach = r * cell_size;
+                if (heap.size() == k && heap.front() <= reach * reach) {
+                    break;
+                }
+            }
+
+            // Neighbors that weren't found within MAX_RING cells are at least that far away.
+            float sum = (k - heap.size()) * (MAX_RING * cell_size);
+            for (float d2 : heap) {
+                sum += std::sqrt(d2);
+            }
+            mean_dist[c] = sum / k;
+        }
+    });
+
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    for (float d : mean_dist) {
+        sum += d;
+        sum_sq += (double)d * d;
+    }
+    double mean = sum / n_on_grid;
+    double variance = sum_sq / n_on_grid - mean * mean;
+    double threshold = mean + opts.outlier_std_ratio * std::sqrt(std::max(0.0, variance));
+
+    for (size_t c = 0; c < n_on_grid; ++c) {
+        if (mean_dist[c] > threshold) {
+            verdicts[keyed[c].second] = OUTLIER;
+        }
+    }
+}
+
+}  // namespace
+
+std::vector<size_t> compact::filter(float const* rows,
+                                    size_t n,
+                                    Options const& opts,
+                                    Stats& stats) {
+    std::vector<Verdict> verdicts(n, KEEP);
+
+    if (opts.enabled) {
+        parallel_for(n, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                verdicts[i] = check_splat(rows + i * NUM_FIELDS, opts);
+            }
+        });
+        if (opts.outlier_neighbors > 0) {
+            mark_outliers(rows, verdicts, opts);
+        }
+    }
+
+    stats = Stats{};
+    stats.total = n;
+    std::vector<size_t> kept{};
+    kept.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        switch (verdicts[i]) {
+            case KEEP:
+                kept.push_back(i);
+                break;
+            case DEGENERATE:
+                ++stats.degenerate;
+                break;
+            case TRANSPARENT:
+                ++stats.transparent;
+                break;
+            case OUTLIER:
+                ++stats.outliers;
+                break;
+        }
+    }
+    stats.kept = kept.size();
+    return kept;
+}
+
+void compact::print_stats(Stats const& stats) {
+    std::cout << "Compaction kept " << stats.kept << " of " << stats.total << " gaussians\n"
+              << "  degenerate:  " << stats.degenerate << "\n"
+              << "  transparent: " << stats.transparent << "\n"
+              << "  outliers:    " << stats.outliers << "\n";
+}
+
+void compact::write_ply(std::string const& path,
+                        float const* rows,
+                        std::vector<size_t> const& kept) {
+    std::ofstream file{path, std::ios::binary};
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file " + path + "!");
+    }
+
+    file << "ply\n"
+         << "format binary_little_endian 1.0\n"
+         << "element vertex " << kept.size() << "\n";
+    for (auto const& name : FIELD_NAMES) {
+        file << "property float " << name << "\n";
+    }
+    file << "end_header\n";
+
+    // Rows are written as-is, which assumes a little endian host.
+    for (size_t i : kept) {
+        file.write(reinterpret_cast<char const*>(rows + i * NUM_FIELDS),
+                   NUM_FIELDS * sizeof(float));
+    }
+    if (!file) {
+        throw std::runtime_error("Failed to write " + path + "!");
+    }
+}
+
+}  // namespace splat
@@ -0,0 +1,75 @@
+#ifndef COMPACT_HPP
+#define COMPACT_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace splat::compact {
+
+// Columns of a raw splat row, in the order `App::load_data` extracts them from the .ply file.
+enum Field {
+    X,
+    Y,
+    Z,
+    F_DC_0,
+    F_DC_1,
+    F_DC_2,
+    OPACITY,
+    SCALE_0,
+    SCALE_1,
+    SCALE_2,
+    ROT_0,
+    ROT_1,
+    ROT_2,
+    ROT_3,
+    NUM_FIELDS,
+};
+
+// .ply property name for every `Field`.
+extern const std::vector<std::string> FIELD_NAMES;
+
+struct Options {
+    bool enabled = true;
+    // Splats whose sigmoid opacity is below this can never contribute to an 8-bit pixel.
+    float min_opacity = 1.0f / 255.0f;
+    // Bounds on the (exponentiated) scales and on the ratio between largest and smallest scale.
+    // Flat splats are common and render fine, so the ratio is unbounded unless this is set > 0.
+    float min_scale = 1e-7f;
+    float max_scale = 1e4f;
+    float max_anisotropy = 0.0f;
+    // Statistical outlier removal: a splat is dropped if the mean distance to its
+    // `outlier_neighbors` nearest neighbors exceeds mean + `outlier_std_ratio` * stddev of that
+    // distance over all splats.  Set `outlier_neighbors` to 0 to disable.
+    size_t outlier_neighbors = 8;
+    float outlier_std_ratio = 3.0f;
+    // If non-empty, the compacted scene is written to this path as binary .ply.
+    std::string output_path = "";
+};
+
+// Number of splats removed by each rule.  A splat is only counted for the first rule it fails.
+struct Stats {
+    size_t total = 0;
+    size_t degenerate = 0;
+    size_t transparent = 0;
+    size_t outliers = 0;
+    size_t kept = 0;
+};
+
+/**
+ * Filter `n` raw splat rows of `NUM_FIELDS` floats each.  Returns the indices of the rows that
+ * remain, in their original order, and fills in `stats`.
+ */
+std::vector<size_t> filter(float const* rows, size_t n, Options const& opts, Stats& stats);
+
+void print_stats(Stats const& stats);
+
+/**
+ * Write the rows listed in `kept` to `path` as a binary little endian .ply.  Only the properties
+ * in `FIELD_NAMES` are written, so higher order spherical harmonics are lost.
+ */
+void write_ply(std::string const& path, float const* rows, std::vector<size_t> const& kept);
+
+}  // namespace splat::compact
+
+#endif  // COMPACT_HPP